@@ -0,0 +1,50 @@
+#include <core/core.hpp>
+#include <core/layout.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main() {
+  std::cout << "Enter a Bril JSON File Path" << std::endl;
+  std::string path;
+  std::cin >> path;
+
+  std::ifstream progFile(path);
+  if (!progFile.is_open()) {
+    std::cout << "Cannot access the file" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::cout << "Enter an edge profile path (or - to use static heuristics)"
+            << std::endl;
+  std::string profilePath;
+  std::cin >> profilePath;
+
+  EdgeProfile profile;
+  if (!profilePath.empty() && profilePath != "-") {
+    std::ifstream profileFile(profilePath);
+    if (!profileFile.is_open()) {
+      std::cout << "Cannot access the profile" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    profile = EdgeProfile(profileFile);
+  }
+
+  Program pg(progFile);
+  for (auto &func : pg.funcs) {
+    size_t before = func.instructions.size();
+    applyBlockLayout(func, &profile);
+
+    std::cout << "-------------------------------------------\n";
+    std::cout << func.name << " : " << before << " -> "
+              << func.instructions.size() << " instructions\n";
+    std::cout << "-------------------------------------------\n";
+    for (const auto &instr : func.instructions) {
+      if (instr.instrType == Instruction::LABEL_INSTR) {
+        std::cout << '.' << instr.to_string() << ":\n";
+      } else {
+        std::cout << "  " << instr.to_string() << '\n';
+      }
+    }
+  }
+}
@@ -0,0 +1,125 @@
+#include <core/cbackend.hpp>
+#include <core/core.hpp>
+#include <core/licm.hpp>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// Quote a string for the shell
+std::string shellQuote(const std::string &str) {
+  std::string ret = "'";
+  for (const char c : str) {
+    if (c == '\'') {
+      ret += "'\\''";
+    } else {
+      ret += c;
+    }
+  }
+  return ret + "'";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--emit-c] [--licm] <bril.json> [args...]\n";
+    exit(EXIT_FAILURE);
+  }
+
+  // Options come before the program path
+  bool emitOnly = false;
+  bool licm = false;
+  int pathIdx = 1;
+  for (; pathIdx < argc && std::string(argv[pathIdx]).starts_with("--");
+       pathIdx++) {
+    std::string option = argv[pathIdx];
+    if (option == "--emit-c") {
+      emitOnly = true;
+    } else if (option == "--licm") {
+      licm = true;
+    } else {
+      std::cerr << "Unknown option " << option << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (pathIdx >= argc) {
+    std::cerr << "Missing Bril JSON File Path\n";
+    exit(EXIT_FAILURE);
+  }
+
+  std::ifstream progFile(argv[pathIdx]);
+  if (!progFile.is_open()) {
+    std::cerr << "Cannot access the file" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  // Generate the whole file first so a rejected program leaves nothing
+  // half written behind
+  std::ostringstream code;
+  try {
+    Program pg(progFile);
+    if (licm) {
+      for (auto &func : pg.funcs) {
+        LoopInvariantCodeMotion(func).run();
+      }
+    }
+    CBackend(pg).emit(code);
+  } catch (const std::exception &e) {
+    std::cerr << "bril2c: " << e.what() << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (emitOnly) {
+    std::cout << code.str();
+    return 0;
+  }
+
+  // mkdtemp creates the directory only readable by us, so nothing else can
+  // plant a file or a symlink where the source and the binary go
+  namespace fs = std::filesystem;
+  std::string dirTemplate =
+      (fs::temp_directory_path() / "bril2c_XXXXXX").string();
+  if (!mkdtemp(dirTemplate.data())) {
+    std::cerr << "Cannot create a temporary directory" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  fs::path dir = dirTemplate;
+  fs::path cPath = dir / "prog.c";
+  fs::path exePath = dir / "prog";
+  auto cleanup = [&]() {
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+  };
+
+  {
+    std::ofstream cFile(cPath);
+    cFile << code.str();
+    if (!cFile) {
+      std::cerr << "Cannot write " << cPath << std::endl;
+      cleanup();
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // Use the system C compiler unless CC says otherwise
+  const char *cc = std::getenv("CC");
+  std::string compile = std::string(cc ? cc : "cc") + " -O2 -o " +
+                        shellQuote(exePath) + " " + shellQuote(cPath);
+  if (std::system(compile.c_str()) != 0) {
+    std::cerr << "Compiling the generated C failed" << std::endl;
+    cleanup();
+    exit(EXIT_FAILURE);
+  }
+
+  std::string run = shellQuote(exePath);
+  for (int i = pathIdx + 1; i < argc; i++) {
+    run += " " + shellQuote(argv[i]);
+  }
+  int status = std::system(run.c_str());
+
+  cleanup();
+  return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+}
@@ -0,0 +1,406 @@
+#include "cbackend.hpp"
+#include "layout.hpp"
+#include <cctype>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+/// Runtime support shared by every translated program
+const char *RUNTIME = R"(#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static _Noreturn void bril_error(const char *msg) {
+  fflush(stdout);
+  fprintf(stderr, "error: %s\n", msg);
+  exit(2);
+}
+
+/* Bril ints wrap around on overflow, signed overflow is UB in C */
+static inline int64_t bril_add(int64_t a, int64_t b) {
+  return (int64_t)((uint64_t)a + (uint64_t)b);
+}
+
+static inline int64_t bril_sub(int64_t a, int64_t b) {
+  return (int64_t)((uint64_t)a - (uint64_t)b);
+}
+
+static inline int64_t bril_mul(int64_t a, int64_t b) {
+  return (int64_t)((uint64_t)a * (uint64_t)b);
+}
+
+static inline int64_t bril_div(int64_t a, int64_t b) {
+  if (b == 0)
+    bril_error("division by zero");
+  if (a == INT64_MIN && b == -1)
+    return INT64_MIN;
+  return a / b;
+}
+
+static inline void bril_print_int(int64_t x) { printf("%" PRId64, x); }
+
+static inline void bril_print_bool(bool x) { fputs(x ? "true" : "false", stdout); }
+
+static int64_t bril_parse_int(const char *arg) {
+  char *end;
+  int64_t x = strtoll(arg, &end, 10);
+  if (*arg == '\0' || *end != '\0')
+    bril_error("expected an int argument");
+  return x;
+}
+
+static bool bril_parse_bool(const char *arg) {
+  if (strcmp(arg, "true") == 0)
+    return true;
+  if (strcmp(arg, "false") == 0)
+    return false;
+  bril_error("expected a bool argument");
+}
+
+)";
+
+const std::unordered_map<std::string, std::string> INT_CALLS = {
+    {"add", "bril_add"},
+    {"sub", "bril_sub"},
+    {"mul", "bril_mul"},
+    {"div", "bril_div"},
+};
+
+const std::unordered_map<std::string, std::string> INFIX_OPS = {
+    {"eq", "=="}, {"lt", "<"},   {"gt", ">"},   {"le", "<="},
+    {"ge", ">="}, {"and", "&&"}, {"or", "||"},
+};
+
+} // namespace
+
+std::string CBackend::mangle(const std::string &prefix,
+                             const std::string &name) {
+  std::string ret = prefix;
+  for (const char c : name) {
+    if (std::isalnum(static_cast<unsigned char>(c))) {
+      ret += c;
+    } else if (c == '_') {
+      ret += "__";
+    } else {
+      char hex[4];
+      std::snprintf(hex, sizeof(hex), "_%02x", static_cast<unsigned char>(c));
+      ret += hex;
+    }
+  }
+  return ret;
+}
+
+std::string CBackend::cType(const Type type) {
+  switch (type) {
+  case INT:
+    return "int64_t";
+  case BOOL:
+    return "bool";
+  default:
+    return "void";
+  }
+}
+
+CBackend::VarTypes
+CBackend::collectVarTypes(const FunctionBlock &func) const {
+  VarTypes vars;
+  auto define = [&](const std::string &var, Type type) {
+    auto [it, inserted] = vars.insert({var, type});
+    if (!inserted && it->second != type) {
+      throw std::runtime_error("Variable " + var + " of " + func.name +
+                               " is defined with two different types");
+    }
+  };
+
+  for (const auto &[arg, type] : func.args) {
+    define(arg, type);
+  }
+  for (const auto &instr : func.instructions) {
+    if (instr.dest.empty()) {
+      continue;
+    }
+    Type type = instr.destType;
+    // Untyped constants are typed by their value
+    if (type == NONE && instr.instrType == Instruction::CONST_INSTR) {
+      type = (instr.value == "true" || instr.value == "false") ? BOOL : INT;
+    }
+    if (type == NONE) {
+      throw std::runtime_error("Variable " + instr.dest + " of " + func.name +
+                               " has no type");
+    }
+    define(instr.dest, type);
+  }
+  return vars;
+}
+
+std::string CBackend::signature(const FunctionBlock &func) const {
+  std::string ret = cType(func.type) + " " + mangle("f_", func.name) + "(";
+  if (func.args.empty()) {
+    ret += "void";
+  }
+  for (size_t i = 0; i < func.args.size(); i++) {
+    if (i) {
+      ret += ", ";
+    }
+    ret += cType(func.args[i].second) + " " + mangle("v_", func.args[i].first);
+  }
+  return ret + ")";
+}
+
+void CBackend::emitRuntime(std::ostream &out) const { out << RUNTIME; }
+
+void CBackend::emit(std::ostream &out) const {
+  emitRuntime(out);
+  for (const auto &func : program.funcs) {
+    out << "static " << signature(func) << ";\n";
+  }
+  out << '\n';
+  for (const auto &func : program.funcs) {
+    emitFunction(out, func);
+  }
+  emitMain(out);
+}
+
+void CBackend::emitInstruction(std::ostream &out, const FunctionBlock &func,
+                               const Instruction &instr,
+                               const VarTypes &vars) const {
+  auto var = [&](const std::string &name) {
+    if (!vars.contains(name)) {
+      throw std::runtime_error("Undefined variable " + name + " in " +
+                               func.name);
+    }
+    return mangle("v_", name);
+  };
+  auto expectArgs = [&](size_t count) {
+    if (instr.arg.size() != count) {
+      throw std::runtime_error(instr.op + " in " + func.name + " expects " +
+                               std::to_string(count) + " arguments");
+    }
+  };
+  auto callExpr = [&]() {
+    if (instr.funcs.size() != 1) {
+      throw std::runtime_error("call in " + func.name +
+                               " must name exactly one function");
+    }
+    std::string ret = mangle("f_", instr.funcs[0]) + "(";
+    for (size_t i = 0; i < instr.arg.size(); i++) {
+      ret += (i ? ", " : "") + var(instr.arg[i]);
+    }
+    return ret + ")";
+  };
+
+  out << "  ";
+  if (instr.instrType == Instruction::CONST_INSTR) {
+    std::string value = instr.value;
+    if (vars.at(instr.dest) == BOOL) {
+      // Every type but int parses as BOOL, a float must not become true
+      if (value != "true" && value != "false") {
+        throw std::runtime_error("constant " + value + " of " + instr.dest +
+                                 " in " + func.name + " is not a bool");
+      }
+    } else if (value == "-9223372036854775808") {
+      // -2^63 does not fit in a C literal before it is negated
+      value = "INT64_MIN";
+    } else {
+      value = "INT64_C(" + value + ")";
+    }
+    out << var(instr.dest) << " = " << value << ";\n";
+  } else if (INT_CALLS.contains(instr.op)) {
+    expectArgs(2);
+    out << var(instr.dest) << " = " << INT_CALLS.at(instr.op) << "("
+        << var(instr.arg[0]) << ", " << var(instr.arg[1]) << ");\n";
+  } else if (INFIX_OPS.contains(instr.op)) {
+    expectArgs(2);
+    out << var(instr.dest) << " = " << var(instr.arg[0]) << " "
+        << INFIX_OPS.at(instr.op) << " " << var(instr.arg[1]) << ";\n";
+  } else if (instr.op == "not") {
+    expectArgs(1);
+    out << var(instr.dest) << " = !" << var(instr.arg[0]) << ";\n";
+  } else if (instr.op == "id") {
+    expectArgs(1);
+    out << var(instr.dest) << " = " << var(instr.arg[0]) << ";\n";
+  } else if (instr.op == "call") {
+    if (!instr.dest.empty()) {
+      out << var(instr.dest) << " = ";
+    }
+    out << callExpr() << ";\n";
+  } else if (instr.op == "print") {
+    for (size_t i = 0; i < instr.arg.size(); i++) {
+      if (i) {
+        out << "putchar(' '); ";
+      }
+      std::string arg = var(instr.arg[i]);
+      out << (vars.at(instr.arg[i]) == INT ? "bril_print_int("
+                                           : "bril_print_bool(")
+          << arg << "); ";
+    }
+    out << "putchar('\\n');\n";
+  } else if (instr.op == "ret") {
+    if (instr.arg.empty()) {
+      out << "return;\n";
+    } else {
+      out << "return " << var(instr.arg[0]) << ";\n";
+    }
+  } else if (instr.op == "nop") {
+    out << ";\n";
+  } else {
+    throw std::runtime_error("Unsupported instruction " + instr.op + " in " +
+                             func.name);
+  }
+}
+
+void CBackend::emitFunction(std::ostream &out,
+                            const FunctionBlock &func) const {
+  const CFG &graph = func.getGraph();
+  VarTypes vars = collectVarTypes(func);
+
+  out << "static " << signature(func) << " {\n";
+  std::unordered_set<std::string> params;
+  for (const auto &[arg, type] : func.args) {
+    params.insert(arg);
+  }
+  for (const auto &[name, type] : vars) {
+    if (!params.contains(name)) {
+      out << "  " << cType(type) << " " << mangle("v_", name) << " = 0;\n";
+    }
+  }
+
+  std::vector<CFG::vertex_descriptor> order;
+  if (num_vertices(graph)) {
+    order = BlockLayout(func).computeLayout();
+  }
+  auto isNext = [&](size_t i, CFG::vertex_descriptor v) {
+    return i + 1 < order.size() && order[i + 1] == v;
+  };
+  auto blockLabel = [](CFG::vertex_descriptor v) {
+    return "b" + std::to_string(v);
+  };
+
+  // Successor taken for each label of a branch, and the fall-through
+  auto successors = [&](CFG::vertex_descriptor v) {
+    std::unordered_map<std::string, CFG::vertex_descriptor> succs;
+    auto [oe_begin, oe_end] = out_edges(v, graph);
+    for (; oe_begin != oe_end; ++oe_begin) {
+      succs[graph[*oe_begin].label] = target(*oe_begin, graph);
+    }
+    return succs;
+  };
+
+  // Block body and gotos go through a buffer so only the labels that are
+  // actually jumped to get emitted
+  std::vector<std::string> bodies(order.size());
+  std::unordered_set<CFG::vertex_descriptor> jumpedTo;
+  auto jump = [&](std::ostream &body, CFG::vertex_descriptor v) {
+    jumpedTo.insert(v);
+    body << "goto " << blockLabel(v) << ";";
+  };
+  for (size_t i = 0; i < order.size(); i++) {
+    std::ostringstream body;
+    const std::vector<Instruction> &instrs = graph[order[i]].instructions;
+    auto succs = successors(order[i]);
+    bool terminated = false;
+    for (const auto &instr : instrs) {
+      if (instr.op == "jmp") {
+        CFG::vertex_descriptor dst = succs.at(instr.labels[0]);
+        if (!isNext(i, dst)) {
+          body << "  ";
+          jump(body, dst);
+          body << '\n';
+        }
+        terminated = true;
+      } else if (instr.op == "br") {
+        if (instr.arg.size() != 1 || instr.labels.size() != 2) {
+          throw std::runtime_error("Malformed br in " + func.name);
+        }
+        std::string cond = mangle("v_", instr.arg[0]);
+        CFG::vertex_descriptor ifTrue = succs.at(instr.labels[0]);
+        CFG::vertex_descriptor ifFalse = succs.at(instr.labels[1]);
+        // Invert the branch when the true side is the next block
+        if (ifTrue == ifFalse) {
+          if (!isNext(i, ifTrue)) {
+            body << "  ";
+            jump(body, ifTrue);
+            body << '\n';
+          }
+        } else if (isNext(i, ifTrue)) {
+          body << "  if (!" << cond << ") ";
+          jump(body, ifFalse);
+          body << '\n';
+        } else {
+          body << "  if (" << cond << ") ";
+          jump(body, ifTrue);
+          body << '\n';
+          if (!isNext(i, ifFalse)) {
+            body << "  ";
+            jump(body, ifFalse);
+            body << '\n';
+          }
+        }
+        terminated = true;
+      } else {
+        emitInstruction(body, func, instr, vars);
+        terminated = instr.op == "ret";
+      }
+    }
+
+    if (!terminated) {
+      if (succs.contains("")) {
+        if (!isNext(i, succs.at(""))) {
+          body << "  ";
+          jump(body, succs.at(""));
+          body << '\n';
+        }
+      } else if (func.type == NONE) {
+        body << "  return;\n";
+      } else {
+        body << "  bril_error(\"" << func.name
+             << " reached its end without returning\");\n";
+      }
+    }
+    bodies[i] = body.str();
+  }
+
+  for (size_t i = 0; i < order.size(); i++) {
+    if (jumpedTo.contains(order[i])) {
+      out << blockLabel(order[i]) << ":;\n";
+    }
+    out << bodies[i];
+  }
+  out << "}\n\n";
+}
+
+void CBackend::emitMain(std::ostream &out) const {
+  const FunctionBlock *brilMain = nullptr;
+  for (const auto &func : program.funcs) {
+    if (func.name == "main") {
+      brilMain = &func;
+    }
+  }
+  if (!brilMain) {
+    throw std::runtime_error("Program has no main function");
+  }
+
+  size_t argc = brilMain->args.size();
+  out << "int main(int argc, char **argv) {\n";
+  out << "  if (argc != " << argc + 1 << ")\n";
+  out << "    bril_error(\"main expects " << argc << " arguments\");\n";
+  out << "  " << mangle("f_", "main") << "(";
+  for (size_t i = 0; i < argc; i++) {
+    out << (i ? ", " : "")
+        << (brilMain->args[i].second == INT ? "bril_parse_int"
+                                            : "bril_parse_bool")
+        << "(argv[" << i + 1 << "])";
+  }
+  out << ");\n";
+  out << "  return 0;\n";
+  out << "}\n";
+}
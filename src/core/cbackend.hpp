@@ -0,0 +1,42 @@
+#pragma once
+
+#include "core.hpp"
+#include <map>
+#include <ostream>
+#include <string>
+
+/**
+ * Translate a whole Program into a single self contained C translation
+ * unit. Bril variables become typed locals, blocks become labels, `br` and
+ * `jmp` become gotos and calls become direct C calls. Ints follow Bril's
+ * 64 bit wrapping semantics and the generated `main` parses the arguments
+ * of the Bril `main` function from the command line.
+ */
+class CBackend {
+private:
+  using VarTypes = std::map<std::string, Type>;
+
+  const Program &program;
+
+  /// Make a Bril name usable as a C identifier with the given prefix
+  static std::string mangle(const std::string &prefix, const std::string &name);
+
+  static std::string cType(const Type type);
+
+  /// Type of every variable of the function, including its arguments
+  VarTypes collectVarTypes(const FunctionBlock &func) const;
+
+  std::string signature(const FunctionBlock &func) const;
+
+  void emitRuntime(std::ostream &out) const;
+  void emitFunction(std::ostream &out, const FunctionBlock &func) const;
+  void emitInstruction(std::ostream &out, const FunctionBlock &func,
+                       const Instruction &instr, const VarTypes &vars) const;
+  void emitMain(std::ostream &out) const;
+
+public:
+  CBackend(const Program &program) : program(program) {};
+
+  /// Write the C translation of the program to out
+  void emit(std::ostream &out) const;
+};
@@ -190,7 +190,30 @@ using CFG =
  */
 class FunctionBlock {
 private:
-  CFG::vertex_descriptor rootBlock = -1;
+  CFG::vertex_descriptor rootBlock = CFG::null_vertex();
+
+  /// Control Flow Graph of this function
+  CFG graph;
+
+  /**
+   * Analyses derived from the shape of the CFG. They are computed together
+   * on first use and dropped whenever a block or an edge is added or
+   * removed, so any number of passes can query them for the price of one
+   * traversal. References they hand out do not survive such an edit.
+   */
+  struct CFGAnalyses {
+    bool valid = false;
+    std::vector<CFG::vertex_descriptor> postOrder;
+    std::vector<CFG::vertex_descriptor> rpo;
+    /// Position of each block in rpo, UNREACHABLE if it is not in it
+    std::vector<size_t> rpoIndex;
+    std::vector<std::vector<CFG::vertex_descriptor>> successors;
+    std::vector<std::vector<CFG::vertex_descriptor>> predecessors;
+  };
+  mutable CFGAnalyses analyses;
+
+  /// Compute the analyses if the CFG changed since they were last used
+  const CFGAnalyses &getAnalyses() const;
 
 public:
   /// Is this the function that is run on entry point
@@ -207,34 +230,74 @@ public:
   /// Instructions in the function. This is used to construct BB
   std::vector<Instruction> instructions;
 
-  /// Instructions in the function. This is used to construct BB
-  std::vector<BasicBlock> basicBlocks;
-
   FunctionBlock(std::string, std::vector<std::pair<std::string, Type>>,
                 std::vector<Instruction>, Type);
   // FunctionBlock(std::string name, std::vector<BasicBlock> rootBasicBlock);
 
+  /// RPO index of the blocks the entry block cannot reach
+  static constexpr size_t UNREACHABLE = -1;
+
   /// Control Flow Graph of this function
-  CFG graph;
+  const CFG &getGraph() const { return graph; }
 
   /// Create a file with the dot specification of the control flow
   /// graph of this func
   void exportToDot(const std::string &filename) const;
 
-  /// Compute Reverse PostOrderTraversal of the Control Flow graph
-  std::vector<CFG::vertex_descriptor> computeRPO() const;
+  /// Reverse postorder of the blocks reachable from the entry block
+  const std::vector<CFG::vertex_descriptor> &getRPO() const;
 
-  /// Compute Reverse PostOrderTraversal of the Control Flow graph
-  std::vector<CFG::vertex_descriptor> computePO() const;
+  /// Postorder of the blocks reachable from the entry block
+  const std::vector<CFG::vertex_descriptor> &getPostOrder() const;
+
+  /// Position of every block in getRPO(), UNREACHABLE for the others
+  const std::vector<size_t> &getRPOIndex() const;
+
+  /// Can the block be reached from the entry block
+  bool isReachable(const CFG::vertex_descriptor &vd) const;
+
+  /// Get the entry block of the function
+  CFG::vertex_descriptor getRootBlock() const;
+
+  /// Replace the instructions of the function and rebuild its CFG
+  void setInstructions(const std::vector<Instruction> &instrs);
+
+  /**
+   * @brief Linearize the CFG in the given block order
+   *
+   * Jumps to the next block are dropped, fall-through edges that are broken
+   * get an explicit `jmp` and labels nobody refers to are removed.
+   *
+   * @param[in] order Blocks to emit, entry block first
+   * @return The new instruction stream of the function
+   */
+  std::vector<Instruction>
+  linearize(const std::vector<CFG::vertex_descriptor> &order) const;
 
   /// Get BasicBlock from graph
   BasicBlock getBasicBlock(const CFG::vertex_descriptor &vd) const;
 
+  /// Instructions of a block can be edited in place, this keeps the cached
+  /// analyses since the shape of the CFG does not change
+  BasicBlock &editBasicBlock(const CFG::vertex_descriptor &vd);
+
+  /// Add a block without edges to the CFG
+  CFG::vertex_descriptor addBasicBlock(const BasicBlock &bb);
+
+  /// Add an edge to the CFG
+  void addEdge(const CFG::vertex_descriptor &src,
+               const CFG::vertex_descriptor &dst, const Edge &e);
+
+  /// Remove every edge from src to dst
+  void removeEdges(const CFG::vertex_descriptor &src,
+                   const CFG::vertex_descriptor &dst);
+
   /// Get sucessors of a vertex
-  std::vector<CFG::vertex_descriptor>
+  const std::vector<CFG::vertex_descriptor> &
   getSucessors(const CFG::vertex_descriptor &vd) const;
 
-  std::vector<CFG::vertex_descriptor>
+  /// Get predecessors of a vertex
+  const std::vector<CFG::vertex_descriptor> &
   getPredecessors(const CFG::vertex_descriptor &vd) const;
 };
 /**
@@ -0,0 +1,57 @@
+#include "defined.hpp"
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+
+void DefinedVariableAnalysis::analyze() {
+  const std::vector<CFG::vertex_descriptor> &rpo = func.getRPO();
+  CFG::vertex_descriptor root = func.getRootBlock();
+
+  // A block not computed yet stands for "every variable", so it is left out
+  // of the intersection instead of emptying it
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const auto &v : rpo) {
+      VarSet in;
+      if (v == root) {
+        for (const auto &[arg, type] : func.args) {
+          in.insert(arg);
+        }
+      } else {
+        bool first = true;
+        for (const auto &pred : func.getPredecessors(v)) {
+          auto predOut = DefOut.find(pred);
+          if (predOut == DefOut.end()) {
+            continue;
+          }
+          if (first) {
+            in = predOut->second;
+            first = false;
+            continue;
+          }
+          std::vector<std::string> temp;
+          std::set_intersection(in.begin(), in.end(), predOut->second.begin(),
+                                predOut->second.end(),
+                                std::back_inserter(temp));
+          in = VarSet(temp.begin(), temp.end());
+        }
+      }
+
+      VarSet out = in;
+      for (const auto &instr : func.getGraph()[v].instructions) {
+        if (!instr.dest.empty()) {
+          out.insert(instr.dest);
+        }
+      }
+
+      auto oldOut = DefOut.find(v);
+      if (oldOut == DefOut.end() || oldOut->second != out) {
+        changed = true;
+      }
+      DefIn[v] = in;
+      DefOut[v] = out;
+    }
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "core.hpp"
+#include <set>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Variables that are assigned on every path from the entry of the function
+ * to a block. Bril faults on reading a variable that was never assigned, so
+ * code may only move to a point where all of its operands are in here.
+ * Blocks the entry cannot reach are left out.
+ */
+class DefinedVariableAnalysis {
+private:
+  const FunctionBlock &func;
+  using VarSet = std::set<std::string>;
+  using DefinedResult = std::unordered_map<CFG::vertex_descriptor, VarSet>;
+
+public:
+  DefinedResult DefIn;
+  DefinedResult DefOut;
+  DefinedVariableAnalysis(const FunctionBlock &func) : func(func) {};
+
+  void analyze();
+};
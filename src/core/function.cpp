@@ -1,10 +1,12 @@
 #include "core.hpp"
+#include <algorithm>
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/detail/adjacency_list.hpp>
 #include <boost/graph/graph_utility.hpp>
 #include <boost/graph/properties.hpp>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 class VertexWriter {
@@ -41,18 +43,6 @@ private:
   const CFG &graph;
 };
 
-class PostOrderVisitor : public boost::default_dfs_visitor {
-private:
-  std::vector<CFG::vertex_descriptor> &vertexOrder;
-
-public:
-  PostOrderVisitor(std::vector<CFG::vertex_descriptor> &vertexOrder)
-      : vertexOrder(vertexOrder) {};
-  void finish_vertex(const CFG::vertex_descriptor v, const CFG &g) {
-    vertexOrder.push_back(v);
-  }
-};
-
 FunctionBlock::FunctionBlock(std::string name,
                              std::vector<std::pair<std::string, Type>> args,
                              std::vector<Instruction> instructions,
@@ -73,10 +63,9 @@ FunctionBlock::FunctionBlock(std::string name,
       }
       BasicBlock bb =
           BasicBlock({instr}, name + "_BLOCK_" + std::to_string(instr_cnt));
-      basicBlocks.push_back(bb);
 
       CFG::vertex_descriptor vd = boost::add_vertex(bb, graph);
-      if (rootBlock == -1) {
+      if (rootBlock == CFG::null_vertex()) {
         rootBlock = vd;
       }
       vd_map[instr_cnt++] = vd;
@@ -84,6 +73,21 @@ FunctionBlock::FunctionBlock(std::string name,
     }
   }
 
+  // Labels at the very end of the function still need a block to jump to
+  bool trailingLabels = !label_store.empty();
+  if (trailingLabels) {
+    for (std::string &x : label_store) {
+      label_to_instr[x] = instr_cnt;
+    }
+    BasicBlock bb = BasicBlock(name + "_BLOCK_" + std::to_string(instr_cnt));
+
+    CFG::vertex_descriptor vd = boost::add_vertex(bb, graph);
+    if (rootBlock == CFG::null_vertex()) {
+      rootBlock = vd;
+    }
+    vd_map[instr_cnt] = vd;
+  }
+
   bool jumped = false;
   for (int i = 0; Instruction & instr : instructions) {
     if (instr.instrType != Instruction::LABEL_INSTR) {
@@ -104,12 +108,20 @@ FunctionBlock::FunctionBlock(std::string name,
         boost::add_edge(vd_map[i], vd_map[label_to_instr[instr.labels[1]]], e2,
                         graph);
         jumped = true;
+      } else if (instr.op == "ret") {
+        // Control never falls through a return
+        jumped = true;
       } else {
         jumped = false;
       }
       i++;
     }
   }
+
+  if (trailingLabels && !jumped && instr_cnt) {
+    Edge e("", Edge::FLOW);
+    boost::add_edge(vd_map[instr_cnt - 1], vd_map[instr_cnt], e, graph);
+  }
 }
 
 /**
@@ -122,39 +134,80 @@ void FunctionBlock::exportToDot(const std::string &filename) const {
 }
 
 /**
- * Get RPOrder of CFG of this function.
+ * Compute every analysis in one pass over the CFG. The DFS follows the out
+ * edges in order, like boost::depth_first_search, but never leaves the part
+ * of the graph the entry block reaches.
  */
-std::vector<CFG::vertex_descriptor> FunctionBlock::computeRPO() const {
-  std::vector<CFG::vertex_descriptor> post_order;
-  std::vector<boost::default_color_type> colors(num_vertices(graph));
+const FunctionBlock::CFGAnalyses &FunctionBlock::getAnalyses() const {
+  if (analyses.valid) {
+    return analyses;
+  }
+  size_t n = num_vertices(graph);
+  analyses = CFGAnalyses();
+  analyses.successors.resize(n);
+  analyses.predecessors.resize(n);
+  for (CFG::vertex_descriptor v = 0; v < n; v++) {
+    auto [oe_begin, oe_end] = out_edges(v, graph);
+    for (; oe_begin != oe_end; ++oe_begin) {
+      analyses.successors[v].push_back(target(*oe_begin, graph));
+    }
+    auto [ie_begin, ie_end] = boost::in_edges(v, graph);
+    for (; ie_begin != ie_end; ++ie_begin) {
+      analyses.predecessors[v].push_back(source(*ie_begin, graph));
+    }
+  }
+
+  analyses.rpoIndex.assign(n, UNREACHABLE);
+  if (n) {
+    std::vector<bool> visited(n, false);
+    // Block and the index of the next successor to visit
+    std::vector<std::pair<CFG::vertex_descriptor, size_t>> stack;
+    stack.push_back({rootBlock, 0});
+    visited[rootBlock] = true;
+    while (!stack.empty()) {
+      auto &[v, next] = stack.back();
+      if (next == analyses.successors[v].size()) {
+        analyses.postOrder.push_back(v);
+        stack.pop_back();
+        continue;
+      }
+      CFG::vertex_descriptor succ = analyses.successors[v][next++];
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack.push_back({succ, 0});
+      }
+    }
+  }
+  analyses.rpo.assign(analyses.postOrder.rbegin(), analyses.postOrder.rend());
+  for (size_t i = 0; i < analyses.rpo.size(); i++) {
+    analyses.rpoIndex[analyses.rpo[i]] = i;
+  }
+  analyses.valid = true;
+  return analyses;
+}
 
-  PostOrderVisitor visitor(post_order);
+const std::vector<CFG::vertex_descriptor> &FunctionBlock::getRPO() const {
+  return getAnalyses().rpo;
+}
 
-  boost::depth_first_search(
-      graph, visitor,
-      make_iterator_property_map(colors.begin(),
-                                 get(boost::vertex_index, graph)),
-      rootBlock);
-  return post_order;
+const std::vector<CFG::vertex_descriptor> &
+FunctionBlock::getPostOrder() const {
+  return getAnalyses().postOrder;
 }
 
-/**
- * @brief Compute Post Order
- *
- */
-std::vector<CFG::vertex_descriptor> FunctionBlock::computePO() const {
-  std::vector<CFG::vertex_descriptor> post_order;
-  std::vector<boost::default_color_type> colors(num_vertices(graph));
+const std::vector<size_t> &FunctionBlock::getRPOIndex() const {
+  return getAnalyses().rpoIndex;
+}
 
-  PostOrderVisitor visitor(post_order);
+bool FunctionBlock::isReachable(const CFG::vertex_descriptor &vd) const {
+  return getAnalyses().rpoIndex[vd] != UNREACHABLE;
+}
 
-  boost::depth_first_search(
-      graph, visitor,
-      make_iterator_property_map(colors.begin(),
-                                 get(boost::vertex_index, graph)),
-      rootBlock);
-  std::reverse(post_order.begin(), post_order.end());
-  return post_order;
+/**
+ * Entry block of the function
+ */
+CFG::vertex_descriptor FunctionBlock::getRootBlock() const {
+  return rootBlock;
 }
 
 /**
@@ -165,28 +218,143 @@ FunctionBlock::getBasicBlock(const CFG::vertex_descriptor &vd) const {
   return graph[vd];
 }
 
+/**
+ * Retrieve basic block associated with the vertex descriptor for editing
+ */
+BasicBlock &FunctionBlock::editBasicBlock(const CFG::vertex_descriptor &vd) {
+  return graph[vd];
+}
+
+CFG::vertex_descriptor FunctionBlock::addBasicBlock(const BasicBlock &bb) {
+  analyses.valid = false;
+  return boost::add_vertex(bb, graph);
+}
+
+void FunctionBlock::addEdge(const CFG::vertex_descriptor &src,
+                            const CFG::vertex_descriptor &dst, const Edge &e) {
+  analyses.valid = false;
+  boost::add_edge(src, dst, e, graph);
+}
+
+void FunctionBlock::removeEdges(const CFG::vertex_descriptor &src,
+                                const CFG::vertex_descriptor &dst) {
+  analyses.valid = false;
+  boost::remove_edge(src, dst, graph);
+}
+
 /**
  * Get sucessor of the basic block
  */
-std::vector<CFG::vertex_descriptor>
+const std::vector<CFG::vertex_descriptor> &
 FunctionBlock::getSucessors(const CFG::vertex_descriptor &vd) const {
-  std::vector<CFG::vertex_descriptor> successors;
-  auto [ei_begin, ei_end] = out_edges(vd, graph);
-  for (; ei_begin != ei_end; ++ei_begin) {
-    successors.push_back(target(*ei_begin, graph));
-  }
-  return successors;
+  return getAnalyses().successors[vd];
 }
 
 /**
  * Get predecssors of the basic block
  */
-std::vector<CFG::vertex_descriptor>
+const std::vector<CFG::vertex_descriptor> &
 FunctionBlock::getPredecessors(const CFG::vertex_descriptor &vd) const {
-  std::vector<CFG::vertex_descriptor> pred;
-  auto [ei_begin, ei_end] = boost::in_edges(vd, graph);
+  return getAnalyses().predecessors[vd];
+}
+
+/**
+ * Replace the instructions and rebuild the CFG from them
+ */
+void FunctionBlock::setInstructions(const std::vector<Instruction> &instrs) {
+  bool isRoot = isRootFunction;
+  *this = FunctionBlock(name, args, instrs, type);
+  isRootFunction = isRoot;
+}
+
+/**
+ * Linearize the CFG in the given block order
+ */
+std::vector<Instruction> FunctionBlock::linearize(
+    const std::vector<CFG::vertex_descriptor> &order) const {
+  size_t n = num_vertices(graph);
+
+  auto isNext = [&](size_t i, CFG::vertex_descriptor v) {
+    return i + 1 < order.size() && order[i + 1] == v;
+  };
+
+  // Labels that branches already use to reach each block
+  std::unordered_set<std::string> usedLabels;
+  for (const auto &instr : instructions) {
+    if (instr.instrType == Instruction::LABEL_INSTR) {
+      usedLabels.insert(instr.label_instr);
+    }
+  }
+  std::vector<std::vector<std::string>> blockLabels(n);
+  auto [ei_begin, ei_end] = boost::edges(graph);
   for (; ei_begin != ei_end; ++ei_begin) {
-    pred.push_back(source(*ei_begin, graph));
+    const Edge &e = graph[*ei_begin];
+    std::vector<std::string> &labels = blockLabels[target(*ei_begin, graph)];
+    if (e.type != Edge::FLOW &&
+        std::find(labels.begin(), labels.end(), e.label) == labels.end()) {
+      labels.push_back(e.label);
+      usedLabels.insert(e.label);
+    }
+  }
+  auto labelOf = [&](CFG::vertex_descriptor v) {
+    if (blockLabels[v].empty()) {
+      std::string label = graph[v].blockName;
+      while (usedLabels.contains(label)) {
+        label += "_";
+      }
+      usedLabels.insert(label);
+      blockLabels[v].push_back(label);
+    }
+    return blockLabels[v].front();
+  };
+
+  // Decide which broken fall-throughs need a jump before emitting labels
+  std::vector<std::string> flowJump(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    auto [oe_begin, oe_end] = out_edges(order[i], graph);
+    for (; oe_begin != oe_end; ++oe_begin) {
+      CFG::vertex_descriptor succ = target(*oe_begin, graph);
+      if (graph[*oe_begin].type == Edge::FLOW && !isNext(i, succ)) {
+        flowJump[i] = labelOf(succ);
+      }
+    }
+  }
+
+  std::vector<Instruction> instrs;
+  for (size_t i = 0; i < order.size(); i++) {
+    const BasicBlock &bb = graph[order[i]];
+    for (const auto &label : blockLabels[order[i]]) {
+      instrs.push_back(Instruction(label));
+    }
+    for (const auto &instr : bb.instructions) {
+      if (&instr == &bb.instructions.back() && instr.op == "jmp") {
+        auto [oe_begin, oe_end] = out_edges(order[i], graph);
+        if (oe_begin != oe_end && isNext(i, target(*oe_begin, graph))) {
+          continue;
+        }
+      }
+      instrs.push_back(instr);
+    }
+
+    if (!flowJump[i].empty()) {
+      instrs.push_back(Instruction("jmp", {}, {}, {flowJump[i]}));
+    } else if (out_degree(order[i], graph) == 0 && i + 1 < order.size() &&
+               (bb.instructions.empty() || bb.instructions.back().op != "ret")) {
+      // The function used to fall off the end here
+      instrs.push_back(Instruction("ret", {}, {}, {}));
+    }
+  }
+
+  // Drop the labels that no branch refers to anymore
+  std::unordered_set<std::string> referenced;
+  for (const auto &instr : instrs) {
+    if (instr.op == "jmp" || instr.op == "br") {
+      referenced.insert(instr.labels.begin(), instr.labels.end());
+    }
   }
-  return pred;
+  std::erase_if(instrs, [&](const Instruction &instr) {
+    return instr.instrType == Instruction::LABEL_INSTR &&
+           !referenced.contains(instr.label_instr);
+  });
+  return instrs;
 }
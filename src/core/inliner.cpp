@@ -0,0 +1,288 @@
+#include "inliner.hpp"
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+/// Number of instructions, labels excluded
+size_t codeSize(const std::vector<Instruction> &instrs) {
+  return std::count_if(instrs.begin(), instrs.end(), [](const auto &instr) {
+    return instr.instrType != Instruction::LABEL_INSTR;
+  });
+}
+
+/// Parameters the function assigns to, they cannot simply be replaced by
+/// the arguments of an inlined call
+std::unordered_set<std::string> assignedArgs(const FunctionBlock &func) {
+  std::unordered_set<std::string> assigned;
+  for (const auto &instr : func.instructions) {
+    for (const auto &[arg, type] : func.args) {
+      if (instr.dest == arg) {
+        assigned.insert(arg);
+      }
+    }
+  }
+  return assigned;
+}
+
+} // namespace
+
+CallGraph::CallGraph(const Program &program) {
+  size_t n = program.funcs.size();
+  for (size_t i = 0; i < n; i++) {
+    funcIndex[program.funcs[i].name] = i;
+  }
+
+  callees.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    for (const auto &instr : program.funcs[i].instructions) {
+      if (instr.op != "call") {
+        continue;
+      }
+      for (const auto &callee : instr.funcs) {
+        int j = getIndex(callee);
+        if (j != -1 && std::find(callees[i].begin(), callees[i].end(), j) ==
+                           callees[i].end()) {
+          callees[i].push_back(j);
+        }
+      }
+    }
+  }
+
+  // Tarjan's algorithm emits every component after the ones it reaches,
+  // which is exactly callees before callers
+  std::vector<int> index(n, -1), lowlink(n, 0);
+  std::vector<bool> onStack(n, false);
+  std::vector<size_t> stack;
+  int counter = 0;
+  scc.assign(n, 0);
+  std::function<void(size_t)> connect = [&](size_t v) {
+    index[v] = lowlink[v] = counter++;
+    stack.push_back(v);
+    onStack[v] = true;
+    for (const auto &w : callees[v]) {
+      if (index[w] == -1) {
+        connect(w);
+        lowlink[v] = std::min(lowlink[v], lowlink[w]);
+      } else if (onStack[w]) {
+        lowlink[v] = std::min(lowlink[v], index[w]);
+      }
+    }
+    if (lowlink[v] == index[v]) {
+      std::vector<size_t> component;
+      size_t w;
+      do {
+        w = stack.back();
+        stack.pop_back();
+        onStack[w] = false;
+        scc[w] = bottomUp.size();
+        component.push_back(w);
+      } while (w != v);
+      bottomUp.push_back(component);
+    }
+  };
+  for (size_t v = 0; v < n; v++) {
+    if (index[v] == -1) {
+      connect(v);
+    }
+  }
+}
+
+int CallGraph::getIndex(const std::string &name) const {
+  auto it = funcIndex.find(name);
+  return it == funcIndex.end() ? -1 : it->second;
+}
+
+bool FunctionInliner::shouldInline(const FunctionBlock &caller,
+                                   const Instruction &call,
+                                   const FunctionBlock &callee) const {
+  if (call.arg.size() != callee.args.size() ||
+      (callee.type == NONE && !call.dest.empty())) {
+    return false;
+  }
+
+  // Arguments with a single, constant definition in the caller
+  std::unordered_map<std::string, std::pair<int, bool>> defs;
+  for (const auto &instr : caller.instructions) {
+    if (!instr.dest.empty()) {
+      auto &[count, isConst] = defs[instr.dest];
+      count++;
+      isConst = instr.instrType == Instruction::CONST_INSTR;
+    }
+  }
+  size_t constArgs = 0;
+  for (const auto &arg : call.arg) {
+    auto def = defs.find(arg);
+    if (def != defs.end() && def->second.first == 1 && def->second.second) {
+      constArgs++;
+    }
+  }
+
+  // Copies of the assigned parameters and of the returned values
+  size_t copies = assignedArgs(callee).size();
+  if (!call.dest.empty()) {
+    copies += std::count_if(callee.instructions.begin(),
+                            callee.instructions.end(), [](const auto &instr) {
+                              return instr.op == "ret" && !instr.arg.empty();
+                            });
+  }
+  size_t cost = codeSize(callee.instructions) + copies;
+  size_t benefit = CALL_OVERHEAD + CONST_ARG_BONUS * constArgs;
+  return cost <= benefit + threshold;
+}
+
+std::vector<Instruction>
+FunctionInliner::instantiate(const FunctionBlock &caller,
+                             const Instruction &call,
+                             const FunctionBlock &callee) {
+  // Only the blocks the callee can actually reach are copied
+  std::vector<Instruction> body;
+  size_t n = num_vertices(callee.getGraph());
+  if (n) {
+    std::vector<CFG::vertex_descriptor> order;
+    for (CFG::vertex_descriptor v = 0; v < n; v++) {
+      if (callee.isReachable(v)) {
+        order.push_back(v);
+      }
+    }
+    body = callee.linearize(order);
+  }
+
+  std::unordered_set<std::string> taken;
+  for (const auto &[arg, type] : caller.args) {
+    taken.insert(arg);
+  }
+  for (const auto &instr : caller.instructions) {
+    taken.insert(instr.dest);
+    taken.insert(instr.label_instr);
+    taken.insert(instr.arg.begin(), instr.arg.end());
+  }
+  std::unordered_set<std::string> calleeNames, calleeLabels;
+  for (const auto &[arg, type] : callee.args) {
+    calleeNames.insert(arg);
+  }
+  for (const auto &instr : body) {
+    calleeNames.insert(instr.dest);
+    calleeNames.insert(instr.arg.begin(), instr.arg.end());
+    calleeLabels.insert(instr.label_instr);
+  }
+  calleeNames.insert(calleeLabels.begin(), calleeLabels.end());
+
+  // Prefix every callee name with the callee and a fresh site number
+  std::string prefix;
+  std::string retLabel = "return";
+  while (calleeLabels.contains(retLabel)) {
+    retLabel += "_";
+  }
+  calleeNames.insert(retLabel);
+  bool clash = true;
+  while (clash) {
+    prefix = callee.name + "." + std::to_string(site++) + ".";
+    clash = std::any_of(calleeNames.begin(), calleeNames.end(),
+                        [&](const auto &name) {
+                          return taken.contains(prefix + name);
+                        });
+  }
+  auto rename = [&](const std::string &name) { return prefix + name; };
+  retLabel = rename(retLabel);
+
+  // A parameter the callee never assigns to can read the caller's argument
+  // directly, nothing in the inlined body writes to that
+  std::unordered_set<std::string> assigned = assignedArgs(callee);
+  std::unordered_map<std::string, std::string> bound;
+  std::vector<Instruction> instrs;
+  for (size_t i = 0; i < callee.args.size(); i++) {
+    const auto &[arg, type] = callee.args[i];
+    if (assigned.contains(arg)) {
+      instrs.push_back(
+          Instruction("id", rename(arg), type, {call.arg[i]}, {}, {}));
+    } else {
+      bound[arg] = call.arg[i];
+    }
+  }
+  for (Instruction instr : body) {
+    if (instr.instrType == Instruction::LABEL_INSTR) {
+      instr.label_instr = rename(instr.label_instr);
+      instrs.push_back(instr);
+      continue;
+    }
+    if (!instr.dest.empty()) {
+      instr.dest = rename(instr.dest);
+    }
+    for (auto &arg : instr.arg) {
+      arg = bound.contains(arg) ? bound[arg] : rename(arg);
+    }
+    for (auto &label : instr.labels) {
+      label = rename(label);
+    }
+
+    if (instr.op == "ret") {
+      if (!call.dest.empty() && !instr.arg.empty()) {
+        Type type = call.destType == NONE ? callee.type : call.destType;
+        instrs.push_back(
+            Instruction("id", call.dest, type, {instr.arg[0]}, {}, {}));
+      }
+      instrs.push_back(Instruction("jmp", {}, {}, {retLabel}));
+    } else {
+      instrs.push_back(instr);
+    }
+  }
+  // The last return falls through to the label without a jump
+  if (!instrs.empty() && instrs.back().op == "jmp" &&
+      instrs.back().labels[0] == retLabel) {
+    instrs.pop_back();
+  }
+  instrs.push_back(Instruction(retLabel));
+  return instrs;
+}
+
+bool FunctionInliner::run() {
+  CallGraph callGraph(program);
+  bool changed = false;
+
+  for (const auto &component : callGraph.bottomUp) {
+    for (const auto &f : component) {
+      FunctionBlock &caller = program.funcs[f];
+      std::vector<Instruction> instrs;
+      bool inlinedHere = false;
+
+      for (const auto &instr : caller.instructions) {
+        int g = instr.op == "call" && instr.funcs.size() == 1
+                    ? callGraph.getIndex(instr.funcs[0])
+                    : -1;
+        // Calls within a component are recursive, inlining never ends
+        if (g != -1 && callGraph.scc[g] != callGraph.scc[f] &&
+            shouldInline(caller, instr, program.funcs[g])) {
+          std::vector<Instruction> body =
+              instantiate(caller, instr, program.funcs[g]);
+          // The call itself goes away
+          size_t added = codeSize(body);
+          if (added <= budget + 1) {
+            budget = budget + 1 - added;
+            instrs.insert(instrs.end(), body.begin(), body.end());
+            inlined++;
+            inlinedHere = true;
+            continue;
+          }
+        }
+        instrs.push_back(instr);
+      }
+
+      if (inlinedHere) {
+        // Relinearize to drop the jumps to return labels that fall through
+        caller.setInstructions(instrs);
+        std::vector<CFG::vertex_descriptor> order(
+            num_vertices(caller.getGraph()));
+        std::iota(order.begin(), order.end(), 0);
+        caller.setInstructions(caller.linearize(order));
+        changed = true;
+      }
+    }
+  }
+  return changed;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "core.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Call graph of a Program. Functions are referred to by their index in
+ * Program::funcs.
+ */
+class CallGraph {
+private:
+  std::unordered_map<std::string, size_t> funcIndex;
+
+public:
+  /// Functions called by each function, without duplicates
+  std::vector<std::vector<size_t>> callees;
+
+  /// Strongly connected component of each function
+  std::vector<size_t> scc;
+
+  /// Strongly connected components with callees before their callers
+  std::vector<std::vector<size_t>> bottomUp;
+
+  CallGraph(const Program &program);
+
+  /// Index of the function with that name, -1 if there is none
+  int getIndex(const std::string &name) const;
+};
+
+/**
+ * Inline small functions into their callers. Each call site is weighed
+ * with a size/benefit cost model:
+ *
+ *   cost    = callee size + one copy per parameter the callee assigns to
+ *             and per returned value
+ *   benefit = CALL_OVERHEAD + CONST_ARG_BONUS per argument that is a
+ *             constant in the caller
+ *
+ * and inlined when cost - benefit stays under the threshold and the
+ * growth fits in what is left of the code size budget. Functions are
+ * visited bottom-up in the call graph, so callees are already inlined
+ * into when their callers are looked at, and calls inside a strongly
+ * connected component are never inlined.
+ *
+ * Parameters the callee never assigns to are replaced by the caller's
+ * arguments instead of being copied, so a call with a single return runs
+ * at most one extra copy, paid for by the `call` and `ret` that go away.
+ */
+class FunctionInliner {
+private:
+  Program &program;
+
+  /// Instructions the remaining inlining may still add to the program
+  size_t budget;
+  size_t threshold;
+
+  /// Does the cost model favour inlining this call
+  bool shouldInline(const FunctionBlock &caller, const Instruction &call,
+                    const FunctionBlock &callee) const;
+
+  /**
+   * @brief Copy of the callee's body for one call site
+   *
+   * Variables and labels are renamed apart from the caller, parameters are
+   * replaced by the arguments or copied from them when the callee assigns
+   * to them, and every `ret` becomes a copy into the call's destination
+   * followed by a jump past the inlined body.
+   */
+  std::vector<Instruction> instantiate(const FunctionBlock &caller,
+                                       const Instruction &call,
+                                       const FunctionBlock &callee);
+
+  /// Number of call sites inlined so far, used to name the copies
+  size_t site = 0;
+
+public:
+  /// Call overhead removed by inlining: the `call` and the `ret`
+  static constexpr size_t CALL_OVERHEAD = 2;
+  /// Benefit of an argument that becomes a known constant
+  static constexpr size_t CONST_ARG_BONUS = 2;
+  static constexpr size_t DEFAULT_THRESHOLD = 30;
+
+  /// Number of call sites inlined so far
+  size_t inlined = 0;
+
+  /**
+   * @param[in] program Program to inline calls in
+   * @param[in] budget Maximum number of instructions inlining may add
+   * @param[in] threshold Maximum cost - benefit of an inlined call
+   */
+  FunctionInliner(Program &program, size_t budget,
+                  size_t threshold = DEFAULT_THRESHOLD)
+      : program(program), budget(budget), threshold(threshold) {};
+
+  /// Inline every profitable call site. Returns whether anything changed
+  bool run();
+};
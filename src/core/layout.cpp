@@ -0,0 +1,255 @@
+#include "layout.hpp"
+#include <algorithm>
+#include <cmath>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+EdgeProfile::EdgeProfile(std::ifstream &profileFile) {
+  using json = nlohmann::json;
+
+  if (!profileFile.is_open()) {
+    throw std::runtime_error("Couldn't open the provided profile\n");
+  }
+
+  json profileJsonObj = json::parse(profileFile);
+  for (const auto &[funcName, funcEdges] : profileJsonObj.items()) {
+    for (const auto &edge : funcEdges) {
+      if (!edge.contains("from") || !edge.contains("to") ||
+          !edge.contains("count")) {
+        throw std::runtime_error("Malformed edge in profile of " + funcName);
+      }
+      EdgeKey key = {edge["from"].get<std::string>(),
+                     edge["to"].get<std::string>()};
+      counts[funcName][key] += edge["count"].get<double>();
+    }
+  }
+}
+
+bool EdgeProfile::hasFunction(const std::string &func) const {
+  return counts.contains(func);
+}
+
+double EdgeProfile::getCount(const std::string &func, const std::string &from,
+                             const std::string &to) const {
+  auto funcIt = counts.find(func);
+  if (funcIt == counts.end()) {
+    return 0;
+  }
+  auto edgeIt = funcIt->second.find({from, to});
+  return edgeIt == funcIt->second.end() ? 0 : edgeIt->second;
+}
+
+BlockLayout::BlockLayout(const FunctionBlock &func, const EdgeProfile *profile)
+    : func(func), loops(func) {
+  const CFG &graph = func.getGraph();
+  if (num_vertices(graph) == 0) {
+    return;
+  }
+
+  auto [ei_begin, ei_end] = boost::edges(graph);
+  for (; ei_begin != ei_end; ++ei_begin) {
+    WeightedEdge e;
+    e.src = source(*ei_begin, graph);
+    e.dst = target(*ei_begin, graph);
+    e.type = graph[*ei_begin].type;
+    e.isBackEdge = loops.isBackEdge(e.src, e.dst);
+    edges.push_back(e);
+  }
+
+  if (profile && profile->hasFunction(func.name)) {
+    readProfileWeights(*profile);
+  } else {
+    estimateStaticWeights();
+  }
+}
+
+/**
+ * Estimate edge weights as freq(src) * prob(edge). Branches favour staying
+ * inside a loop over leaving it, and every loop header is assumed to run
+ * LOOP_SCALE times per entry into the loop.
+ */
+void BlockLayout::estimateStaticWeights() {
+  const CFG &graph = func.getGraph();
+  size_t n = num_vertices(graph);
+
+  std::vector<std::vector<size_t>> outEdges(n), inEdges(n);
+  for (size_t i = 0; i < edges.size(); i++) {
+    outEdges[edges[i].src].push_back(i);
+    inEdges[edges[i].dst].push_back(i);
+  }
+
+  std::vector<double> prob(edges.size(), 0);
+  for (size_t v = 0; v < n; v++) {
+    const std::vector<size_t> &out = outEdges[v];
+    size_t exits = std::count_if(out.begin(), out.end(), [&](size_t i) {
+      return loops.isLoopExit(edges[i].src, edges[i].dst);
+    });
+    for (size_t i : out) {
+      if (exits == 0 || exits == out.size()) {
+        prob[i] = 1.0 / out.size();
+      } else if (loops.isLoopExit(edges[i].src, edges[i].dst)) {
+        prob[i] = (1 - LOOP_BRANCH_PROB) / exits;
+      } else {
+        prob[i] = LOOP_BRANCH_PROB / (out.size() - exits);
+      }
+    }
+  }
+
+  std::vector<double> freq(n, 0);
+  CFG::vertex_descriptor root = func.getRootBlock();
+  for (const auto &v : func.getRPO()) {
+    bool isHeader = false;
+    for (size_t i : inEdges[v]) {
+      if (edges[i].isBackEdge) {
+        isHeader = true;
+      } else {
+        freq[v] += freq[edges[i].src] * prob[i];
+      }
+    }
+    if (v == root) {
+      freq[v] += 1;
+    }
+    if (isHeader) {
+      freq[v] *= LOOP_SCALE;
+    }
+  }
+
+  for (size_t i = 0; i < edges.size(); i++) {
+    edges[i].weight = freq[edges[i].src] * prob[i];
+  }
+}
+
+void BlockLayout::readProfileWeights(const EdgeProfile &profile) {
+  for (auto &e : edges) {
+    e.weight = profile.getCount(func.name, func.getGraph()[e.src].blockName,
+                                func.getGraph()[e.dst].blockName);
+  }
+}
+
+std::vector<CFG::vertex_descriptor> BlockLayout::computeLayout() const {
+  const CFG &graph = func.getGraph();
+  size_t n = num_vertices(graph);
+  if (n == 0) {
+    return {};
+  }
+  CFG::vertex_descriptor root = func.getRootBlock();
+
+  // A `br` names both of its targets, so only fall-throughs and `jmp`s can
+  // be straightened. Those go first, heaviest first, preferring forward
+  // edges on (near) ties so loops keep their test at the bottom. Branch
+  // edges are chained afterwards purely for locality.
+  std::vector<size_t> sorted(edges.size());
+  for (size_t i = 0; i < sorted.size(); i++) {
+    sorted[i] = i;
+  }
+  std::stable_sort(sorted.begin(), sorted.end(), [&](size_t a, size_t b) {
+    const WeightedEdge &ea = edges[a], &eb = edges[b];
+    bool condA = ea.type == Edge::CONDITIONAL;
+    bool condB = eb.type == Edge::CONDITIONAL;
+    if (condA != condB) {
+      return condB;
+    }
+    double eps = 1e-9 * std::max({1.0, ea.weight, eb.weight});
+    if (std::abs(ea.weight - eb.weight) > eps) {
+      return ea.weight > eb.weight;
+    }
+    if (ea.isBackEdge != eb.isBackEdge) {
+      return !ea.isBackEdge;
+    }
+    return ea.type == Edge::FLOW && eb.type != Edge::FLOW;
+  });
+
+  // Block where control falls off the end of the function. Its chain must
+  // stay last or it needs an extra `ret`.
+  auto fallsOff = [&](CFG::vertex_descriptor v) {
+    const std::vector<Instruction> &instrs = graph[v].instructions;
+    return out_degree(v, graph) == 0 &&
+           (instrs.empty() || instrs.back().op != "ret");
+  };
+
+  // Every block starts as its own chain
+  std::vector<std::vector<CFG::vertex_descriptor>> chains(n);
+  std::vector<size_t> chainOf(n);
+  for (size_t v = 0; v < n; v++) {
+    chains[v] = {v};
+    chainOf[v] = v;
+  }
+
+  for (size_t i : sorted) {
+    const WeightedEdge &e = edges[i];
+    // Unreachable blocks are dropped below, they must not drag a reachable
+    // block along with their chain
+    if (!func.isReachable(e.src) || !func.isReachable(e.dst)) {
+      continue;
+    }
+    size_t srcChain = chainOf[e.src], dstChain = chainOf[e.dst];
+    if (srcChain == dstChain || e.dst == root ||
+        chains[srcChain].back() != e.src || chains[dstChain].front() != e.dst) {
+      continue;
+    }
+    if (e.type == Edge::CONDITIONAL && fallsOff(chains[dstChain].back())) {
+      continue;
+    }
+    for (const auto &v : chains[dstChain]) {
+      chainOf[v] = srcChain;
+      chains[srcChain].push_back(v);
+    }
+    chains[dstChain].clear();
+  }
+
+  // Place the entry chain, then keep picking the chain most strongly
+  // connected to what is already placed. The chain falling off the end of
+  // the function comes last and unreachable chains are dropped.
+  const std::vector<size_t> &rpoIndex = func.getRPOIndex();
+
+  std::vector<double> connection(n, -1);
+  std::vector<bool> placed(n, false);
+  auto rank = [&](size_t c) {
+    return std::make_tuple(fallsOff(chains[c].back()), -connection[c],
+                           rpoIndex[chains[c].front()]);
+  };
+  std::vector<CFG::vertex_descriptor> order;
+  size_t next = chainOf[root];
+  while (true) {
+    placed[next] = true;
+    for (const auto &v : chains[next]) {
+      order.push_back(v);
+    }
+    for (const auto &e : edges) {
+      if (chainOf[e.src] == next && !placed[chainOf[e.dst]]) {
+        connection[chainOf[e.dst]] =
+            std::max(connection[chainOf[e.dst]], 0.0) + e.weight;
+      }
+    }
+
+    bool found = false;
+    for (size_t c = 0; c < n; c++) {
+      if (placed[c] || chains[c].empty() ||
+          !func.isReachable(chains[c].front())) {
+        continue;
+      }
+      if (!found || rank(c) < rank(next)) {
+        next = c;
+        found = true;
+      }
+    }
+    if (!found) {
+      break;
+    }
+  }
+  return order;
+}
+
+void applyBlockLayout(FunctionBlock &func, const EdgeProfile *profile) {
+  std::vector<Instruction> instrs;
+  {
+    BlockLayout layout(func, profile);
+    instrs = func.linearize(layout.computeLayout());
+  }
+  func.setInstructions(instrs);
+}
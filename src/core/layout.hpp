@@ -0,0 +1,81 @@
+#pragma once
+
+#include "core.hpp"
+#include "loop.hpp"
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Execution counts of CFG edges. Counts are kept per function and keyed by
+ * the (source, target) block names that FunctionBlock generates, i.e.
+ * `<func>_BLOCK_<n>`.
+ */
+class EdgeProfile {
+public:
+  using EdgeKey = std::pair<std::string, std::string>;
+
+  std::map<std::string, std::map<EdgeKey, double>> counts;
+
+  EdgeProfile() = default;
+
+  /**
+   * Read a profile of the form
+   * {"main": [{"from": "main_BLOCK_0", "to": "main_BLOCK_4", "count": 10}]}
+   */
+  EdgeProfile(std::ifstream &profileFile);
+
+  /// Does the profile have any counts for this function
+  bool hasFunction(const std::string &func) const;
+
+  /// Count of the edge, 0 if it was never taken
+  double getCount(const std::string &func, const std::string &from,
+                  const std::string &to) const;
+};
+
+/**
+ * Pettis-Hansen style basic block layout. Blocks are chained along the
+ * heaviest edges first, chains are then placed starting from the entry.
+ * Blocks the entry cannot reach are dropped.
+ * Edge weights come from an EdgeProfile when one is available for the
+ * function and from static branch heuristics otherwise.
+ */
+class BlockLayout {
+public:
+  struct WeightedEdge {
+    CFG::vertex_descriptor src;
+    CFG::vertex_descriptor dst;
+    Edge::EdgeType type;
+    /// Is this a back edge of a loop
+    bool isBackEdge = false;
+    double weight = 0;
+  };
+
+private:
+  const FunctionBlock &func;
+  std::vector<WeightedEdge> edges;
+  LoopForest loops;
+
+  void estimateStaticWeights();
+  void readProfileWeights(const EdgeProfile &profile);
+
+public:
+  /// Probability of taking the back edge of a loop branch
+  static constexpr double LOOP_BRANCH_PROB = 0.88;
+  /// Assumed trip count of a loop when there is no profile
+  static constexpr double LOOP_SCALE = 10;
+
+  BlockLayout(const FunctionBlock &func, const EdgeProfile *profile = nullptr);
+
+  /// Weighted edges of the CFG
+  const std::vector<WeightedEdge> &getEdges() const { return edges; }
+
+  /// Order in which the reachable blocks should be emitted, entry block first
+  std::vector<CFG::vertex_descriptor> computeLayout() const;
+};
+
+/// Lay out the blocks of func and rebuild it from the new instruction stream
+void applyBlockLayout(FunctionBlock &func,
+                      const EdgeProfile *profile = nullptr);
@@ -0,0 +1,247 @@
+#include "licm.hpp"
+#include <algorithm>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+const std::unordered_set<std::string> LoopInvariantCodeMotion::HOISTABLE_OPS =
+    {"const", "id", "add", "sub", "mul", "eq",  "lt",
+     "gt",    "le", "ge",  "not", "and", "or"};
+
+bool LoopInvariantCodeMotion::run() {
+  bool changed = false;
+  bool hoistedAny = true;
+  while (hoistedAny) {
+    hoistedAny = false;
+    LoopForest forest(func);
+    LiveVariableAnalysis liveness(func);
+    liveness.analyze();
+    DefinedVariableAnalysis defined(func);
+    defined.analyze();
+
+    // Inner loops come after the loops enclosing them. Disjoint loops do not
+    // change each other's analyses, so they can all be done in one round.
+    std::set<CFG::vertex_descriptor> touched;
+    std::unordered_map<CFG::vertex_descriptor, CFG::vertex_descriptor>
+        preheaderOf;
+    for (auto loop = forest.loops.rbegin(); loop != forest.loops.rend();
+         ++loop) {
+      bool overlaps =
+          std::any_of(loop->blocks.begin(), loop->blocks.end(),
+                      [&](const auto &v) { return touched.contains(v); });
+      if (overlaps) {
+        continue;
+      }
+      std::vector<InstrRef> invariants =
+          findInvariants(*loop, forest, liveness, defined);
+      if (invariants.empty()) {
+        continue;
+      }
+      touched.insert(loop->blocks.begin(), loop->blocks.end());
+      CFG::vertex_descriptor preheader = hoist(*loop, invariants);
+      if (preheader != CFG::null_vertex()) {
+        preheaderOf[loop->header] = preheader;
+      }
+      hoisted += invariants.size();
+      hoistedAny = changed = true;
+    }
+    if (!hoistedAny) {
+      break;
+    }
+
+    // Keep the original block order with each new preheader right before
+    // its header
+    std::set<CFG::vertex_descriptor> created;
+    for (const auto &[header, preheader] : preheaderOf) {
+      created.insert(preheader);
+    }
+    std::vector<CFG::vertex_descriptor> order;
+    for (CFG::vertex_descriptor v = 0; v < num_vertices(func.getGraph());
+         v++) {
+      if (created.contains(v)) {
+        continue;
+      }
+      if (preheaderOf.contains(v)) {
+        order.push_back(preheaderOf[v]);
+      }
+      order.push_back(v);
+    }
+    func.setInstructions(func.linearize(order));
+  }
+  return changed;
+}
+
+std::vector<LoopInvariantCodeMotion::InstrRef>
+LoopInvariantCodeMotion::findInvariants(
+    const Loop &loop, const LoopForest &forest,
+    const LiveVariableAnalysis &liveness,
+    const DefinedVariableAnalysis &defined) const {
+  const CFG &graph = func.getGraph();
+
+  std::unordered_map<std::string, int> defsInLoop;
+  std::vector<std::pair<CFG::vertex_descriptor, CFG::vertex_descriptor>>
+      exitEdges;
+  for (const auto &v : loop.blocks) {
+    for (const auto &instr : graph[v].instructions) {
+      if (!instr.dest.empty()) {
+        defsInLoop[instr.dest]++;
+      }
+    }
+    for (const auto &succ : func.getSucessors(v)) {
+      if (!loop.contains(succ)) {
+        exitEdges.push_back({v, succ});
+      }
+    }
+  }
+
+  const auto &headerLiveIn = liveness.LiveIn.at(loop.header);
+  const auto &headerDefIn = defined.DefIn.at(loop.header);
+  std::vector<InstrRef> invariants;
+  std::set<InstrRef> chosen;
+  std::unordered_set<std::string> invariantVars;
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const auto &v : loop.blocks) {
+      const std::vector<Instruction> &instrs = graph[v].instructions;
+      for (size_t i = 0; i < instrs.size(); i++) {
+        const Instruction &instr = instrs[i];
+        if (chosen.contains({v, i}) || instr.dest.empty() ||
+            !HOISTABLE_OPS.contains(instr.op)) {
+          continue;
+        }
+        if (defsInLoop[instr.dest] != 1 || headerLiveIn.contains(instr.dest)) {
+          continue;
+        }
+        // Operands from outside the loop must hold a value on every path
+        // into the loop, not only on the paths that reach this block
+        bool invariantArgs =
+            std::all_of(instr.arg.begin(), instr.arg.end(), [&](auto &arg) {
+              if (defsInLoop.contains(arg)) {
+                return invariantVars.contains(arg);
+              }
+              return headerDefIn.contains(arg);
+            });
+        if (!invariantArgs) {
+          continue;
+        }
+        // Leaving the loop without running the instruction would expose
+        // the hoisted value to code after the loop. A preheader created
+        // earlier in this round has no liveness yet, so everything counts
+        // as live there.
+        bool safeExits = std::all_of(
+            exitEdges.begin(), exitEdges.end(), [&](const auto &edge) {
+              auto liveIn = liveness.LiveIn.find(edge.second);
+              bool live = liveIn == liveness.LiveIn.end() ||
+                          liveIn->second.contains(instr.dest);
+              return !live || forest.dominates(v, edge.first);
+            });
+        if (!safeExits) {
+          continue;
+        }
+
+        invariants.push_back({v, i});
+        chosen.insert({v, i});
+        invariantVars.insert(instr.dest);
+        changed = true;
+      }
+    }
+  }
+  return invariants;
+}
+
+CFG::vertex_descriptor
+LoopInvariantCodeMotion::hoist(const Loop &loop,
+                               const std::vector<InstrRef> &invariants) {
+  const CFG &graph = func.getGraph();
+  CFG::vertex_descriptor header = loop.header;
+
+  std::vector<Instruction> moved;
+  for (const auto &[v, i] : invariants) {
+    moved.push_back(graph[v].instructions[i]);
+  }
+  // Erase back to front so the remaining indices stay valid
+  std::vector<InstrRef> erased(invariants);
+  std::sort(erased.rbegin(), erased.rend());
+  for (const auto &[v, i] : erased) {
+    std::vector<Instruction> &instrs = func.editBasicBlock(v).instructions;
+    instrs.erase(instrs.begin() + i);
+  }
+
+  std::vector<CFG::vertex_descriptor> outside;
+  for (const auto &pred : func.getPredecessors(header)) {
+    if (!loop.contains(pred) &&
+        std::find(outside.begin(), outside.end(), pred) == outside.end()) {
+      outside.push_back(pred);
+    }
+  }
+
+  // An outside predecessor that only leads to the header already is one
+  bool created = false;
+  CFG::vertex_descriptor preheader;
+  if (outside.size() == 1 && func.getSucessors(outside[0]).size() == 1) {
+    preheader = outside[0];
+    std::vector<Instruction> &instrs =
+        func.editBasicBlock(preheader).instructions;
+    auto pos = instrs.end();
+    if (!instrs.empty() && instrs.back().op == "jmp") {
+      --pos;
+    }
+    instrs.insert(pos, moved.begin(), moved.end());
+  } else {
+    created = true;
+    preheader = func.addBasicBlock(
+        BasicBlock(moved, func.name + "_PREHEADER_" + std::to_string(header)));
+
+    std::unordered_set<std::string> usedLabels;
+    for (const auto &instr : func.instructions) {
+      if (instr.instrType == Instruction::LABEL_INSTR) {
+        usedLabels.insert(instr.label_instr);
+      }
+    }
+    std::unordered_map<std::string, std::string> renamed;
+    auto rename = [&](const std::string &label) {
+      if (!renamed.contains(label)) {
+        std::string fresh = label + "_preheader";
+        while (usedLabels.contains(fresh)) {
+          fresh += "_";
+        }
+        usedLabels.insert(fresh);
+        renamed[label] = fresh;
+      }
+      return renamed[label];
+    };
+
+    // Branches from outside the loop now target the preheader instead
+    for (const auto &pred : outside) {
+      std::vector<Edge> redirected;
+      auto [oe_begin, oe_end] = out_edges(pred, graph);
+      for (; oe_begin != oe_end; ++oe_begin) {
+        if (target(*oe_begin, graph) == header) {
+          redirected.push_back(graph[*oe_begin]);
+        }
+      }
+      func.removeEdges(pred, header);
+
+      for (Edge &e : redirected) {
+        if (e.type != Edge::FLOW) {
+          std::string oldLabel = e.label;
+          e.label = rename(oldLabel);
+          for (auto &label :
+               func.editBasicBlock(pred).instructions.back().labels) {
+            if (label == oldLabel) {
+              label = e.label;
+            }
+          }
+        }
+        func.addEdge(pred, preheader, e);
+      }
+    }
+    func.addEdge(preheader, header, Edge("", Edge::FLOW));
+  }
+
+  return created ? preheader : CFG::null_vertex();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "core.hpp"
+#include "defined.hpp"
+#include "liveness.hpp"
+#include "loop.hpp"
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * Loop invariant code motion. Pure value instructions whose operands do not
+ * change inside a loop are hoisted into the loop's preheader, creating the
+ * preheader when the header has no single outside predecessor to reuse.
+ *
+ * An instruction defining `x` is only moved when
+ *  - it is the only definition of `x` in the loop,
+ *  - `x` is not live into the header, so no use in the loop can see a value
+ *    of `x` from before the loop,
+ *  - every operand is defined by an instruction that is itself being
+ *    hoisted, or not defined in the loop at all and assigned on every path
+ *    into the preheader, since the preheader runs the instruction even when
+ *    the loop would not have, and
+ *  - its block dominates every exiting block after which `x` is live.
+ */
+class LoopInvariantCodeMotion {
+private:
+  /// A block and the index of an instruction in it
+  using InstrRef = std::pair<CFG::vertex_descriptor, size_t>;
+
+  FunctionBlock &func;
+
+  /// Value operations without side effects that can never trap
+  static const std::unordered_set<std::string> HOISTABLE_OPS;
+
+  /// Instructions of the loop that can go to its preheader, in an order
+  /// that keeps definitions before their uses
+  std::vector<InstrRef>
+  findInvariants(const Loop &loop, const LoopForest &forest,
+                 const LiveVariableAnalysis &liveness,
+                 const DefinedVariableAnalysis &defined) const;
+
+  /**
+   * @brief Move the instructions to the preheader of the loop
+   *
+   * Only the CFG is edited, the instructions of func are rebuilt once all
+   * the loops of a round are done.
+   *
+   * @return The preheader if it had to be created, null_vertex otherwise
+   */
+  CFG::vertex_descriptor hoist(const Loop &loop,
+                               const std::vector<InstrRef> &invariants);
+
+public:
+  /// Number of times an instruction was moved into a preheader
+  size_t hoisted = 0;
+
+  LoopInvariantCodeMotion(FunctionBlock &func) : func(func) {};
+
+  /**
+   * @brief Hoist invariants until there is nothing left to move
+   *
+   * Every round hoists out of all loops that do not overlap, innermost
+   * first, using the analyses computed at the start of the round. The loop
+   * enclosing a preheader gets its turn in the next round, so an
+   * instruction can move out of several loops.
+   *
+   * @return Whether any instruction was hoisted
+   */
+  bool run();
+};
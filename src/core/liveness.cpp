@@ -0,0 +1,145 @@
+#include "liveness.hpp"
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+LiveVariableAnalysis::LiveVariableAnalysis(const FunctionBlock &func)
+    : func(func) {
+  for (const auto &bb : func.getPostOrder()) {
+    LiveIn[bb] = VarSet();
+    LiveOut[bb] = VarSet();
+  }
+}
+
+LiveVariableAnalysis::VarSet
+LiveVariableAnalysis::getUsage(const Instruction &instr) const {
+  VarSet uses;
+
+  // Currently just assume anything in arg is being used.
+  for (const std::string &arg : instr.arg) {
+    uses.insert(arg);
+  }
+  return uses;
+}
+
+LiveVariableAnalysis::VarSet
+LiveVariableAnalysis::getDefs(const Instruction &instr) const {
+  VarSet defs;
+
+  // Only one variable being can be defined
+  defs.insert(instr.dest);
+  return defs;
+}
+
+std::pair<LiveVariableAnalysis::VarSet, LiveVariableAnalysis::VarSet>
+LiveVariableAnalysis::computeGenKill(
+    const std::vector<Instruction> &instrs) const {
+  VarSet Gen, Kill;
+
+  for (const auto &instr : instrs) {
+    // FIRST usage then def
+    VarSet usage = getUsage(instr);
+    for (const auto &use : usage) {
+      // It should not preceed its Definition
+      if (!Kill.contains(use)) {
+        Gen.insert(use);
+      }
+    }
+
+    // Everything defined is killed
+    VarSet def = getDefs(instr);
+    Kill.insert(def.begin(), def.end());
+  }
+
+  return {Gen, Kill};
+}
+
+LiveVariableAnalysis::VarSet LiveVariableAnalysis::mergeOut(
+    const std::vector<CFG::vertex_descriptor> &successor) const {
+  VarSet result;
+  for (const CFG::vertex_descriptor &succ : successor) {
+    std::vector<std::string> temp_result;
+    std::set_union(result.begin(), result.end(), LiveIn.at(succ).begin(),
+                   LiveIn.at(succ).end(), std::back_inserter(temp_result));
+    result.insert(temp_result.begin(), temp_result.end());
+  }
+  return result;
+}
+
+void LiveVariableAnalysis::analyze() {
+  // Backward problem, so visit successors before their predecessors
+  const std::vector<CFG::vertex_descriptor> &po = func.getPostOrder();
+  const CFG &graph = func.getGraph();
+  size_t n = num_vertices(graph);
+
+  // Gen and Kill do not change between iterations, so they are computed once
+  // per block and every variable they mention gets a bit
+  std::vector<std::string> names;
+  std::unordered_map<std::string, size_t> ids;
+  auto number = [&](const VarSet &vars) {
+    for (const auto &var : vars) {
+      if (ids.try_emplace(var, names.size()).second) {
+        names.push_back(var);
+      }
+    }
+  };
+  std::unordered_map<CFG::vertex_descriptor, std::pair<VarSet, VarSet>>
+      genKill;
+  for (const auto &bb_descriptor : po) {
+    auto [gen, kill] = computeGenKill(graph[bb_descriptor].instructions);
+    kill.erase("");
+    number(gen);
+    number(kill);
+    genKill[bb_descriptor] = {std::move(gen), std::move(kill)};
+  }
+  size_t numVars = names.size();
+
+  std::vector<IdSet> Gen(n), Kill(n);
+  std::vector<IdSet> In(n, IdSet(numVars)), Out(n, IdSet(numVars));
+  for (const auto &[bb_descriptor, sets] : genKill) {
+    Gen[bb_descriptor].resize(numVars);
+    Kill[bb_descriptor].resize(numVars);
+    for (const auto &var : sets.first) {
+      Gen[bb_descriptor].set(ids.at(var));
+    }
+    for (const auto &var : sets.second) {
+      Kill[bb_descriptor].set(ids.at(var));
+    }
+  }
+
+  bool changed = false;
+  do {
+    changed = false;
+    for (const auto &bb_descriptor : po) {
+      IdSet out(numVars);
+      for (const auto &succ : func.getSucessors(bb_descriptor)) {
+        out |= In[succ];
+      }
+
+      // Now LiveIn = Gen U (LiveOut - Kill)
+      IdSet in = Gen[bb_descriptor] | (out - Kill[bb_descriptor]);
+
+      if (out != Out[bb_descriptor] || in != In[bb_descriptor]) {
+        Out[bb_descriptor] = std::move(out);
+        In[bb_descriptor] = std::move(in);
+        changed = true;
+      }
+    }
+  } while (changed);
+
+  auto toNames = [&](const IdSet &vars) {
+    VarSet result;
+    for (size_t id = vars.find_first(); id != IdSet::npos;
+         id = vars.find_next(id)) {
+      result.insert(names[id]);
+    }
+    return result;
+  };
+  for (const auto &bb_descriptor : po) {
+    LiveIn[bb_descriptor] = toNames(In[bb_descriptor]);
+    LiveOut[bb_descriptor] = toNames(Out[bb_descriptor]);
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core.hpp"
+#include <boost/dynamic_bitset.hpp>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class LiveVariableAnalysis {
+private:
+  const FunctionBlock &func;
+  using VarSet = std::set<std::string>;
+  using LiveResult = std::unordered_map<CFG::vertex_descriptor, VarSet>;
+
+public:
+  /// Variables of the function as bits, numbered by analyze()
+  using IdSet = boost::dynamic_bitset<>;
+
+  LiveResult LiveIn;
+  LiveResult LiveOut;
+  LiveVariableAnalysis(const FunctionBlock &func);
+
+  VarSet getUsage(const Instruction &instr) const;
+
+  VarSet getDefs(const Instruction &instr) const;
+
+  /**
+   * @brief Returns Gen and Kill for a Basic Block
+   *
+   * @param[in] instr Set of instructions to run this on
+   * @return It returns two set `Gen` and `Kill`
+   */
+  std::pair<VarSet, VarSet>
+  computeGenKill(const std::vector<Instruction> &instrs) const;
+
+  /**
+   * @brief Perform merge operation for computing out of a basic block
+   *
+   * @param[in] successor Vertex descriptor of the successor of the block
+   * @return The `VarSet` containing the result
+   */
+  VarSet mergeOut(const std::vector<CFG::vertex_descriptor> &successor) const;
+
+  /**
+   * @brief Compute LiveIn and LiveOut of every reachable block
+   *
+   * The fixpoint runs on bitsets of variable ids, names are only filled in
+   * once it is reached.
+   */
+  void analyze();
+};
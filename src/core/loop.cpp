@@ -0,0 +1,176 @@
+#include "loop.hpp"
+#include <algorithm>
+#include <vector>
+
+LoopForest::LoopForest(const FunctionBlock &func) {
+  size_t n = num_vertices(func.getGraph());
+  idom.assign(n, UNDEFINED);
+  innermost.assign(n, -1);
+  if (n == 0) {
+    return;
+  }
+  computeDominators(func);
+  computeLoops(func);
+}
+
+void LoopForest::computeDominators(const FunctionBlock &func) {
+  CFG::vertex_descriptor root = func.getRootBlock();
+  const std::vector<CFG::vertex_descriptor> &rpo = func.getRPO();
+  const std::vector<size_t> &rpoIndex = func.getRPOIndex();
+
+  auto intersect = [&](CFG::vertex_descriptor a, CFG::vertex_descriptor b) {
+    while (a != b) {
+      while (rpoIndex[a] > rpoIndex[b]) {
+        a = idom[a];
+      }
+      while (rpoIndex[b] > rpoIndex[a]) {
+        b = idom[b];
+      }
+    }
+    return a;
+  };
+
+  idom[root] = root;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const auto &v : rpo) {
+      if (v == root) {
+        continue;
+      }
+      CFG::vertex_descriptor newIdom = UNDEFINED;
+      for (const auto &pred : func.getPredecessors(v)) {
+        if (idom[pred] == UNDEFINED) {
+          continue;
+        }
+        newIdom = newIdom == UNDEFINED ? pred : intersect(pred, newIdom);
+      }
+      if (idom[v] != newIdom) {
+        idom[v] = newIdom;
+        changed = true;
+      }
+    }
+  }
+}
+
+void LoopForest::computeLoops(const FunctionBlock &func) {
+  size_t n = num_vertices(func.getGraph());
+
+  // Natural loop of every header: the header plus everything that reaches
+  // one of its latches without going through the header
+  std::vector<int> loopOf(n, -1);
+  for (CFG::vertex_descriptor v = 0; v < n; v++) {
+    if (!isReachable(v)) {
+      continue;
+    }
+    for (const auto &succ : func.getSucessors(v)) {
+      if (!dominates(succ, v)) {
+        continue;
+      }
+      if (loopOf[succ] == -1) {
+        loopOf[succ] = loops.size();
+        Loop loop;
+        loop.header = succ;
+        loop.blocks.insert(succ);
+        loops.push_back(loop);
+      }
+      Loop &loop = loops[loopOf[succ]];
+      if (std::find(loop.latches.begin(), loop.latches.end(), v) ==
+          loop.latches.end()) {
+        loop.latches.push_back(v);
+      }
+
+      std::vector<CFG::vertex_descriptor> worklist = {v};
+      while (!worklist.empty()) {
+        CFG::vertex_descriptor u = worklist.back();
+        worklist.pop_back();
+        if (loop.blocks.contains(u)) {
+          continue;
+        }
+        loop.blocks.insert(u);
+        for (const auto &pred : func.getPredecessors(u)) {
+          if (isReachable(pred)) {
+            worklist.push_back(pred);
+          }
+        }
+      }
+    }
+  }
+
+  // Enclosing loops are strictly bigger, so they sort first
+  std::stable_sort(loops.begin(), loops.end(),
+                   [](const Loop &a, const Loop &b) {
+                     return a.blocks.size() > b.blocks.size();
+                   });
+
+  for (int i = 0; i < static_cast<int>(loops.size()); i++) {
+    Loop &loop = loops[i];
+    for (int j = i - 1; j >= 0; j--) {
+      if (loops[j].contains(loop.header)) {
+        loop.parent = j;
+        loop.depth = loops[j].depth + 1;
+        loops[j].children.push_back(i);
+        break;
+      }
+    }
+    for (const auto &v : loop.blocks) {
+      innermost[v] = i;
+      for (const auto &succ : func.getSucessors(v)) {
+        if (!loop.contains(succ)) {
+          loop.exits.insert(succ);
+        }
+      }
+    }
+  }
+}
+
+bool LoopForest::isReachable(const CFG::vertex_descriptor &vd) const {
+  return idom[vd] != UNDEFINED;
+}
+
+bool LoopForest::dominates(const CFG::vertex_descriptor &a,
+                           const CFG::vertex_descriptor &b) const {
+  if (!isReachable(a) || !isReachable(b)) {
+    return false;
+  }
+  CFG::vertex_descriptor v = b;
+  while (v != a) {
+    if (idom[v] == v) {
+      return false;
+    }
+    v = idom[v];
+  }
+  return true;
+}
+
+CFG::vertex_descriptor
+LoopForest::getIdom(const CFG::vertex_descriptor &vd) const {
+  return idom[vd];
+}
+
+int LoopForest::getLoopFor(const CFG::vertex_descriptor &vd) const {
+  return innermost[vd];
+}
+
+int LoopForest::getDepth(const CFG::vertex_descriptor &vd) const {
+  return innermost[vd] == -1 ? 0 : loops[innermost[vd]].depth;
+}
+
+bool LoopForest::isHeader(const CFG::vertex_descriptor &vd) const {
+  return innermost[vd] != -1 && loops[innermost[vd]].header == vd;
+}
+
+bool LoopForest::isBackEdge(const CFG::vertex_descriptor &src,
+                            const CFG::vertex_descriptor &dst) const {
+  return isReachable(src) && dominates(dst, src);
+}
+
+bool LoopForest::isLoopExit(const CFG::vertex_descriptor &src,
+                            const CFG::vertex_descriptor &dst) const {
+  for (int l = getLoopFor(src); l != -1; l = loops[l].parent) {
+    if (!loops[l].contains(dst)) {
+      return true;
+    }
+  }
+  return false;
+}
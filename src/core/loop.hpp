@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core.hpp"
+#include <set>
+#include <vector>
+
+/**
+ * A natural loop of the CFG. Back edges sharing a header are merged into a
+ * single loop.
+ */
+class Loop {
+public:
+  /// The only block of the loop reachable from outside it
+  CFG::vertex_descriptor header;
+
+  /// Blocks with a back edge to the header
+  std::vector<CFG::vertex_descriptor> latches;
+
+  /// Every block of the loop, header included
+  std::set<CFG::vertex_descriptor> blocks;
+
+  /// Blocks outside the loop with an edge coming from inside it
+  std::set<CFG::vertex_descriptor> exits;
+
+  /// Nesting depth, outermost loops have depth 1
+  int depth = 1;
+
+  /// Index of the enclosing loop in LoopForest::loops, -1 if outermost
+  int parent = -1;
+
+  /// Indices of the loops directly nested in this one
+  std::vector<int> children;
+
+  bool contains(const CFG::vertex_descriptor &vd) const {
+    return blocks.contains(vd);
+  }
+};
+
+/**
+ * Loop nesting forest of a function. Back edges are the edges whose target
+ * dominates their source, dominators are computed with the iterative
+ * Cooper-Harvey-Kennedy algorithm.
+ */
+class LoopForest {
+private:
+  static constexpr CFG::vertex_descriptor UNDEFINED = -1;
+
+  /// Immediate dominator of each block, UNDEFINED if unreachable
+  std::vector<CFG::vertex_descriptor> idom;
+
+  /// Innermost loop of each block, -1 if it is in no loop
+  std::vector<int> innermost;
+
+  void computeDominators(const FunctionBlock &func);
+  void computeLoops(const FunctionBlock &func);
+
+public:
+  /// Every loop of the function, an enclosing loop comes before the loops
+  /// nested in it
+  std::vector<Loop> loops;
+
+  LoopForest(const FunctionBlock &func);
+
+  /// Can the block be reached from the entry block
+  bool isReachable(const CFG::vertex_descriptor &vd) const;
+
+  /// Does every path from the entry to b go through a
+  bool dominates(const CFG::vertex_descriptor &a,
+                 const CFG::vertex_descriptor &b) const;
+
+  /// Immediate dominator of the block, itself for the entry block
+  CFG::vertex_descriptor getIdom(const CFG::vertex_descriptor &vd) const;
+
+  /// Index of the innermost loop containing the block, -1 if none
+  int getLoopFor(const CFG::vertex_descriptor &vd) const;
+
+  /// Loop nesting depth of the block, 0 outside of loops
+  int getDepth(const CFG::vertex_descriptor &vd) const;
+
+  /// Is the block the header of a loop
+  bool isHeader(const CFG::vertex_descriptor &vd) const;
+
+  /// Is src -> dst a back edge of some loop
+  bool isBackEdge(const CFG::vertex_descriptor &src,
+                  const CFG::vertex_descriptor &dst) const;
+
+  /// Does src -> dst leave a loop that contains src
+  bool isLoopExit(const CFG::vertex_descriptor &src,
+                  const CFG::vertex_descriptor &dst) const;
+};
@@ -0,0 +1,40 @@
+#include <core/core.hpp>
+#include <core/inliner.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main() {
+  std::cout << "Enter a Bril JSON File Path" << std::endl;
+  std::string path;
+  std::cin >> path;
+
+  std::ifstream progFile(path);
+  if (!progFile.is_open()) {
+    std::cout << "Cannot access the file" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  std::cout << "Enter the code size budget (instructions inlining may add)"
+            << std::endl;
+  size_t budget;
+  std::cin >> budget;
+
+  Program pg(progFile);
+  FunctionInliner inliner(pg, budget);
+  inliner.run();
+  std::cout << "Inlined " << inliner.inlined << " call sites\n";
+
+  for (const auto &func : pg.funcs) {
+    std::cout << "-------------------------------------------\n";
+    std::cout << func.name << '\n';
+    std::cout << "-------------------------------------------\n";
+    for (const auto &instr : func.instructions) {
+      if (instr.instrType == Instruction::LABEL_INSTR) {
+        std::cout << '.' << instr.to_string() << ":\n";
+      } else {
+        std::cout << "  " << instr.to_string() << '\n';
+      }
+    }
+  }
+}
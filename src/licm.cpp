@@ -0,0 +1,55 @@
+#include <core/core.hpp>
+#include <core/licm.hpp>
+#include <core/loop.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main() {
+  std::cout << "Enter a Bril JSON File Path" << std::endl;
+  std::string path;
+  std::cin >> path;
+
+  std::ifstream progFile(path);
+  if (!progFile.is_open()) {
+    std::cout << "Cannot access the file" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  Program pg(progFile);
+  for (auto &func : pg.funcs) {
+    std::cout << "-------------------------------------------\n";
+    std::cout << func.name << '\n';
+    std::cout << "-------------------------------------------\n";
+
+    LoopForest forest(func);
+    for (const auto &loop : forest.loops) {
+      std::cout << "Loop at " << func.getBasicBlock(loop.header).blockName
+                << " (depth " << loop.depth << ")\n";
+      std::cout << "Latches: ";
+      for (const auto &vd : loop.latches) {
+        std::cout << func.getBasicBlock(vd).blockName << ' ';
+      }
+      std::cout << "\nBody: ";
+      for (const auto &vd : loop.blocks) {
+        std::cout << func.getBasicBlock(vd).blockName << ' ';
+      }
+      std::cout << "\nExits: ";
+      for (const auto &vd : loop.exits) {
+        std::cout << func.getBasicBlock(vd).blockName << ' ';
+      }
+      std::cout << "\n\n";
+    }
+
+    LoopInvariantCodeMotion licm(func);
+    licm.run();
+    std::cout << "Hoisted " << licm.hoisted << " instructions\n";
+    for (const auto &instr : func.instructions) {
+      if (instr.instrType == Instruction::LABEL_INSTR) {
+        std::cout << '.' << instr.to_string() << ":\n";
+      } else {
+        std::cout << "  " << instr.to_string() << '\n';
+      }
+    }
+  }
+}
@@ -37,7 +37,7 @@ int main() {
 
   for(auto& x : pg.funcs){
     x.exportToDot(x.name + ".dot");
-    auto rpo = x.computeRPO();
+    auto &rpo = x.getRPO();
     for(auto& vd : rpo){
       std::cout<<"Sucessors: \n";
       std::cout<<x.getBasicBlock(vd).blockName<<" : ";